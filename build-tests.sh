@@ -2,41 +2,79 @@
 
 DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
 TEST_DIR="${DIR}/test"
-TEST_FILES="${TEST_DIR}/*.c"
+TEST_FILES=("${TEST_DIR}"/*.c)
 CM_LIB="${DIR}/cmake-build-debug/checkmerge/LLVMCheckMerge.so"
+JOBS="${JOBS:-$(nproc 2>/dev/null || echo 2)}"
 error=0
 
-echo "Building test files in ${TEST_DIR} ..."
+export CM_LIB
 
-for f in $TEST_FILES
-do
-    in=$f
+# Stage 1: compiles a source file and passes the IR file on to the next stage.
+compile() {
+    in=$1
     out="${in%.*}.ll"
 
-    echo "  Building $(basename "${in}")..."
+    if clang -S -O0 -g -emit-llvm "$in" -o "$out" > /dev/null 2>&1; then
+        echo "compiled ${out}"
+    else
+        echo "compile-error ${in}"
+    fi
+}
+
+# Stage 2: analyzes an IR file, streaming every function to the writer as soon as it is analyzed.
+# Stage 3: writes the analysis data to a temporary file which replaces the output when complete.
+# Takes a line of the previous stage, consisting of the status and the path of the file.
+analyze() {
+    status="${1%% *}"
+    in="${1#* }"
+    out="${in}.cm"
+
+    echo "$status ${in}"
 
-    echo "    Compiling $(basename "${in}")..."
+    if [ "$status" != "compiled" ]; then
+        return
+    fi
 
-    clang -S -O0 -g -emit-llvm "$in" -o "$out"
+    opt -load="${CM_LIB}" -checkmerge -checkmerge-output=- -disable-output "$in" 2> /dev/null \
+        | grep -v -x -F -e '---' -e '...' > "${out}.tmp"
 
-    if [ $? -ne 0 ]; then
-        error=$((error + 1))
-        echo "    [!] Error while compiling $(basename "${in}")!"
+    if [ "${PIPESTATUS[0]}" -eq 0 ] && mv "${out}.tmp" "$out"; then
+        echo "analyzed ${out}"
     else
-        echo "      Generated $(basename "${out}")."
+        rm -f "${out}.tmp"
+        echo "analyze-error ${in}"
+    fi
+}
 
-        echo "    Analyzing $(basename "${out}")..."
+export -f compile analyze
 
-        opt -analyze -load="${CM_LIB}" -checkmerge "${out}" > /dev/null 2>&1
+echo "Building test files in ${TEST_DIR} using ${JOBS} jobs per stage..."
 
-        if [ $? -ne 0 ]; then
+# The stages run concurrently, connected by pipes. A pipe only holds a limited number of pending files, so a stage that
+# falls behind makes the previous stage wait instead of letting the backlog grow.
+while read -r status file
+do
+    case "$status" in
+        compiled)
+            echo "  Generated $(basename "${file}")."
+            ;;
+        analyzed)
+            echo "  Generated $(basename "${file}")."
+            ;;
+        compile-error)
             error=$((error + 1))
-            echo "    [!] Error while analyzing $(basename "${in}")!"
-        else
-            echo "      Generated $(basename "${out}.cm")."
-        fi
-    fi
-done
+            echo "  [!] Error while compiling $(basename "${file}")!"
+            ;;
+        analyze-error)
+            error=$((error + 1))
+            echo "  [!] Error while analyzing $(basename "${file}")!"
+            ;;
+    esac
+done < <(
+    printf '%s\n' "${TEST_FILES[@]}" \
+        | xargs -d '\n' -n 1 -P "$JOBS" bash -c 'compile "$0"' \
+        | xargs -d '\n' -n 1 -P "$JOBS" bash -c 'analyze "$0"'
+)
 
 if [ $error -ne 0 ]; then
     echo "[!] Failed with ${error} errors."
@@ -2,13 +2,59 @@
 #include <sstream>
 #include <llvm/Support/FormatVariadic.h>
 #include <fstream>
+#include <iostream>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Analysis/CFLAndersAliasAnalysis.h>
+#include <llvm/Analysis/CFLSteensAliasAnalysis.h>
+#include <llvm/Analysis/GlobalsModRef.h>
+#include <llvm/Analysis/ScalarEvolutionAliasAnalysis.h>
+#include <llvm/Analysis/ScopedNoAliasAA.h>
+#include <llvm/Analysis/TypeBasedAliasAnalysis.h>
+#include <llvm/Config/llvm-config.h>
 #include "DependenceCollector.h"
 #include "SourceVariableMapper.h"
+#include "DebugInfoIndex.h"
+#include "ResultCache.h"
 
 using namespace llvm;
 
 namespace {
 
+    cl::opt<std::string> OutputFilename(
+            "checkmerge-output",
+            cl::desc("Write the CheckMerge analysis data to the given file, use - to stream it to standard output"),
+            cl::value_desc("filename")
+    );
+
+    cl::opt<std::string> CacheDirectory(
+            "checkmerge-cache",
+            cl::desc("Share the CheckMerge analysis data of identical modules through the given cache directory"),
+            cl::value_desc("directory")
+    );
+
+    cl::opt<std::string> CachePolicy(
+            "checkmerge-cache-policy",
+            cl::desc("Pruning policy of the CheckMerge cache, in the format of the ThinLTO cache policy"),
+            cl::value_desc("policy"),
+            cl::init("cache_size_bytes=256m")
+    );
+
+    cl::opt<std::string> CacheKey(
+            "checkmerge-cache-key",
+            cl::desc("Additional text that is part of the CheckMerge cache keys, e.g., the flags of the pass pipeline"),
+            cl::value_desc("text")
+    );
+
+    cl::list<std::string> FunctionNames(
+            "checkmerge-functions",
+            cl::desc("Only analyze the given functions, e.g., the ones selected using the CheckMerge summary"),
+            cl::value_desc("function"),
+            cl::CommaSeparated
+    );
+
+    // Version of the analysis data format, part of the cache keys so outdated entries are never used
+    const char *const CacheVersion = "checkmerge-1";
+
     class line {
         std::string data;
     public:
@@ -27,9 +73,13 @@ namespace {
         Function *function;
         DependencyMap dependencies;
         SourceVariableMap variables;
+        const DebugInfoIndex *debugInfo;
+        const FunctionDebugInfo *functionDebugInfo;
 
         CheckMergePrinter() : FunctionPass(ID) {
             this->function = nullptr;
+            this->debugInfo = nullptr;
+            this->functionDebugInfo = nullptr;
         }
 
         // Pass implementation
@@ -51,8 +101,52 @@ namespace {
         std::string filename;
         std::ofstream fileStream;
 
+        // Stream to write the analysis data to, nullptr if it could not be opened
+        std::ostream *output = nullptr;
+
+        // Whether every function is written as a separate document to standard output
+        bool streaming = false;
+
+        // Cache of analysis data shared with other runs, nullptr if disabled
+        std::unique_ptr<ResultCache> cache;
+        std::string moduleKey;
+
+        // Whether the analysis data of the current function was fetched from the cache
+        bool cached = false;
+
         std::vector<const Instruction *> instructions;
 
+        /**
+         * Lists the optional alias analyses that are available to the memory dependence analysis, as they change the
+         * dependencies that are found.
+         *
+         * @return The names of the available alias analyses.
+         */
+        std::string describeAliasAnalyses() const {
+            std::string result;
+
+            if (getAnalysisIfAvailable<ScopedNoAliasAAWrapperPass>()) {
+                result += "scoped-noalias;";
+            }
+            if (getAnalysisIfAvailable<TypeBasedAAWrapperPass>()) {
+                result += "tbaa;";
+            }
+            if (getAnalysisIfAvailable<GlobalsAAWrapperPass>()) {
+                result += "globals-aa;";
+            }
+            if (getAnalysisIfAvailable<SCEVAAWrapperPass>()) {
+                result += "scev-aa;";
+            }
+            if (getAnalysisIfAvailable<CFLAndersAAWrapperPass>()) {
+                result += "cfl-anders-aa;";
+            }
+            if (getAnalysisIfAvailable<CFLSteensAAWrapperPass>()) {
+                result += "cfl-steens-aa;";
+            }
+
+            return result;
+        }
+
         /**
          * Prepends indentation of the given size to the given string.
          *
@@ -63,6 +157,21 @@ namespace {
             return std::string(2, ' ').append(str);
         }
 
+        /**
+         * Writes indentation of the given depth to the given stream, without building a new string.
+         *
+         * @param out The stream to write to.
+         * @param depth The number of indentation levels.
+         * @return The stream.
+         */
+        static std::ostream &writeIndent(std::ostream &out, unsigned depth) {
+            for (unsigned level = 0; level < depth; level++) {
+                out << "  ";
+            }
+
+            return out;
+        }
+
         /**
          * Prepends indentation of the given size to all lines of the given string.
          *
@@ -87,7 +196,7 @@ namespace {
         std::string formatFunction(Function &function) const {
             std::stringstream out;
 
-            DISubprogram *subprogram = function.getSubprogram();
+            const DISubprogram *subprogram = debugInfo->getSubprogram(&function);
 
             out << formatIdentifier(function) << ':' << '\n';
             out << withIndent(
@@ -121,13 +230,13 @@ namespace {
             std::stringstream out;
             std::stringstream nout;
 
-            const DebugLoc &loc = instruction.getDebugLoc();
+            const DILocation *loc = functionDebugInfo != nullptr ? functionDebugInfo->getLocation(&instruction) : nullptr;
 
             out << formatv("- {0}:", formatIdentifier(instruction)).str() << '\n';
             nout << withIndent(formatv(
                     "opcode: {0}\nlocation: \"{1}\"",
                     instruction.getOpcodeName(),
-                    bool(loc) ? formatLocation(loc.getLine(), loc.getCol()) : ""
+                    loc != nullptr ? formatLocation(loc->getLine(), loc->getColumn()) : ""
             ));
 
             // Source variable
@@ -148,24 +257,24 @@ namespace {
             auto dependencyIter = this->dependencies.find(&instruction);
 
             if (dependencyIter.operator!=(this->dependencies.end())) {
-                DependencySet dependencies = dependencyIter->second;
+                const DependencySet &dependencies = dependencyIter->second;
 
                 nout << withIndent("dependencies:");
 
-                for (DependencyPair dependencyPair : dependencies) {
+                for (const DependencyPair &dependencyPair : dependencies) {
                     std::string dependencyRef;
-                    std::string dependencyType;
 
                     if (dependencyPair.first.getPointer() != nullptr) {
                         dependencyRef = formatIdentifier((Instruction &) *dependencyPair.first.getPointer());
-                        dependencyType = formatDepType(&instruction, dependencyPair.first);
                     } else if (dependencyPair.second != nullptr) {
                         dependencyRef = formatIdentifier((BasicBlock &) *dependencyPair.second);
-                        dependencyType = "Unknown";
                     }
 
+                    // The access type is classified during collection, so only its static token is written here
                     if (!dependencyRef.empty()) {
-                        nout << indentLine(indentLine(formatv(R"("*{0}": "{1}")", dependencyRef, dependencyType))) << '\n';
+                        writeIndent(nout, 2) << "\"*" << dependencyRef << "\": \""
+                                             << DependenceCollector::formatAccessType(dependencyPair.getAccessType())
+                                             << '"' << '\n';
                     }
                 }
             }
@@ -241,26 +350,6 @@ namespace {
 
             return formatIdentifier("instruction", formatv("{0}", std::distance(instructions.begin(), iterator)));
         }
-
-        std::string formatDepType(Instruction *inst, Dependency dependency) const {
-            const Instruction *depInst = dependency.getPointer();
-
-            std::string before = "U", after = "U";
-
-            if (inst->mayReadFromMemory()) {
-                after = "R";
-            } else if (inst->mayWriteToMemory()) {
-                after = "W";
-            }
-
-            if (depInst->mayWriteToMemory()) {
-                before = "W";
-            } else if (depInst->mayReadFromMemory()) {
-                before = "R";
-            }
-
-            return formatv("{0}A{1}", after, before).str();
-        }
     };
 
 }
@@ -269,12 +358,21 @@ void CheckMergePrinter::getAnalysisUsage(AnalysisUsage &usage) const {
     usage.setPreservesAll();
     usage.addRequired<DependenceCollector>();
     usage.addRequired<SourceVariableMapper>();
+    usage.addRequired<DebugInfoIndex>();
 }
 
 bool CheckMergePrinter::runOnFunction(Function &F) {
     this->function = &F;
     this->instructions.clear();
 
+    // Skip functions that are not selected, so their dependencies are never collected
+    if (!FunctionNames.empty() && !is_contained(FunctionNames, F.getName())) {
+        this->dependencies.clear();
+        this->variables.clear();
+        this->cached = false;
+        return false;
+    }
+
     for (BasicBlock &B : F) {
         for (Instruction &I : B) {
             this->instructions.push_back(&I);
@@ -282,12 +380,35 @@ bool CheckMergePrinter::runOnFunction(Function &F) {
     }
 
     // Define analysis results
-    dependencies = getAnalysis<DependenceCollector>().getDependencies();
+    dependencies.clear();
     variables = getAnalysis<SourceVariableMapper>().getMapping();
+    debugInfo = &getAnalysis<DebugInfoIndex>();
+    functionDebugInfo = debugInfo->lookup(&F);
+
+    // Dependencies are only collected if the function is not cached
+    auto analyze = [this, &F]() {
+        dependencies = getAnalysis<DependenceCollector>().getDependencies();
+        return formatFunction(F);
+    };
+
+    std::string result;
+
+    if (this->cache) {
+        // The alias analyses depend on the pipeline opt runs, so they are only known once the function is analyzed
+        std::string key = ResultCache::computeKey(moduleKey + describeAliasAnalyses(), F);
+        result = cache->getOrCompute(key, analyze, cached);
+    } else {
+        result = analyze();
+        cached = false;
+    }
 
     // Write to file
-    if (this->fileStream.is_open()) {
-        fileStream << formatFunction(F);
+    if (this->streaming) {
+        // Frame every function as a YAML document and flush it, so consumers can process it right away
+        *output << "---" << '\n' << result << "..." << '\n';
+        output->flush();
+    } else if (this->output != nullptr) {
+        *output << result;
     }
 
     // No modifications so return false
@@ -305,24 +426,69 @@ void CheckMergePrinter::print(raw_ostream &os, const Module *module) const {
 
     out << formatv("Instructions:    {0}", this->instructions.size()).str() << '\n';
     out << formatv("Variables:       {0}", this->variables.size()).str() << '\n';
-    out << "Dependencies:" << '\n';
-    out << withIndent(formatv("Instructions:  {0}", this->dependencies.size()));
-    out << withIndent(formatv("Total:         {0}", dependencyCount));
+    // Dependencies are not collected for cached functions, so their counts are unknown
+    if (!this->cached) {
+        out << "Dependencies:" << '\n';
+        out << withIndent(formatv("Instructions:  {0}", this->dependencies.size()));
+        out << withIndent(formatv("Total:         {0}", dependencyCount));
+    }
+    out << formatv("Cached:          {0}", this->cached ? "yes" : "no").str() << '\n';
     out << '\n';
-    out << formatv("Written CheckMerge analysis data to file {0}", this->filename).str();
+    if (this->streaming) {
+        out << "Streamed CheckMerge analysis data to standard output";
+    } else {
+        out << formatv("Written CheckMerge analysis data to file {0}", this->filename).str();
+    }
     os << withIndent(out.str());
 }
 
 bool CheckMergePrinter::doInitialization(Module &module) {
-    const std::string &basename = module.getSourceFileName();
-    this->filename = basename.substr(0, basename.find_last_of('.')) + ".ll.cm";
-    this->fileStream.open(filename);
+    if (OutputFilename.empty()) {
+        const std::string &basename = module.getSourceFileName();
+        this->filename = basename.substr(0, basename.find_last_of('.')) + ".ll.cm";
+    } else {
+        this->filename = OutputFilename;
+    }
+
+    this->streaming = this->filename == "-";
+
+    if (this->streaming) {
+        this->output = &std::cout;
+    } else {
+        this->fileStream.open(filename);
+        this->output = this->fileStream.is_open() ? &this->fileStream : nullptr;
+    }
+
+    if (!CacheDirectory.empty()) {
+        Expected<CachePruningPolicy> policy = parseCachePruningPolicy(CachePolicy);
+
+        if (!policy) {
+            errs() << formatv("Invalid CheckMerge cache policy: {0}", toString(policy.takeError())) << '\n';
+            policy = CachePruningPolicy();
+        }
+
+        this->cache = llvm::make_unique<ResultCache>(CacheDirectory, *policy);
+        // Results differ between versions of LLVM and between configurations, so neither share entries
+        std::string options = formatv("{0};{1};{2}", CacheVersion, LLVM_VERSION_STRING, CacheKey).str();
+        this->moduleKey = ResultCache::computeKey(module, options);
+    }
+
+    return false;
 }
 
 bool CheckMergePrinter::doFinalization(Module &module) {
     if (this->fileStream.is_open()) {
         this->fileStream.close();
     }
+
+    this->output = nullptr;
+
+    if (this->cache) {
+        this->cache->prune();
+        this->cache.reset();
+    }
+
+    return false;
 }
 
 char CheckMergePrinter::ID = 0;
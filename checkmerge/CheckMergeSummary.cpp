@@ -0,0 +1,344 @@
+/**
+ * @file CheckMergeSummary.cpp
+ * @author Jan-Jelle Kester
+ *
+ * LLVM pass that writes a compact summary of the source variables each function reads and writes and the functions it
+ * calls. The summary is cheap to compute, so it can be used to select the functions that need the full analysis.
+ */
+#include <llvm/Pass.h>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/CallSite.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/FormatVariadic.h>
+#include "SourceVariableMapper.h"
+#include "DebugInfoIndex.h"
+
+using namespace llvm;
+
+namespace {
+
+    cl::opt<std::string> SummaryFilename(
+            "checkmerge-summary-output",
+            cl::desc("Write the CheckMerge summary to the given file, use - to write it to standard output"),
+            cl::value_desc("filename")
+    );
+
+    /**
+     * Bloom filter over names, using the 64 bit FNV-1a hash and double hashing so other tools can reproduce it.
+     */
+    class NameFilter {
+        static const unsigned Words = 2;
+        static const unsigned Bits = Words * 64;
+        static const unsigned Hashes = 3;
+
+        uint64_t words[Words] = {};
+        unsigned count = 0;
+
+        static uint64_t hash(StringRef name) {
+            uint64_t result = 0xcbf29ce484222325ULL;
+
+            for (unsigned char c : name) {
+                result ^= c;
+                result *= 0x100000001b3ULL;
+            }
+
+            return result;
+        }
+
+    public:
+
+        void insert(StringRef name) {
+            uint64_t value = hash(name);
+            uint32_t h1 = static_cast<uint32_t>(value), h2 = static_cast<uint32_t>(value >> 32);
+
+            for (unsigned i = 0; i < Hashes; i++) {
+                unsigned bit = (h1 + i * h2) % Bits;
+                words[bit / 64] |= uint64_t(1) << (bit % 64);
+            }
+
+            count++;
+        }
+
+        /**
+         * @return The filter as a hexadecimal string, most significant word first, followed by the number of names.
+         */
+        std::string format() const {
+            std::string result;
+            raw_string_ostream out(result);
+
+            for (unsigned i = Words; i > 0; i--) {
+                out << format_hex_no_prefix(words[i - 1], 16);
+            }
+            out << '/' << count;
+
+            return out.str();
+        }
+    };
+
+    struct CheckMergeSummary : public FunctionPass {
+
+        static char ID;
+
+        CheckMergeSummary() : FunctionPass(ID) {}
+
+        // Pass implementation
+        bool runOnFunction(Function &F) override;
+
+        // Printer
+        void print(raw_ostream &os, const Module *module) const override;
+
+        // Define requirements and behavior
+        void getAnalysisUsage(AnalysisUsage &usage) const override;
+
+        // Initialize pass
+        bool doInitialization(Module &module) override;
+
+        bool doFinalization(Module &module) override;
+
+    private:
+
+        Function *function = nullptr;
+
+        std::string filename;
+        std::ofstream fileStream;
+
+        // Stream to write the summary to, nullptr if it could not be opened
+        std::ostream *output = nullptr;
+
+        SourceVariableMap variables;
+
+        // Names read, written and called by the current function
+        StringSet<> reads, writes, calls;
+
+        // Number of memory accesses and calls that could not be attributed to a name
+        unsigned unresolved = 0;
+
+        /**
+         * Resolves the source variable or global variable a pointer is based on.
+         *
+         * @param pointer The pointer to resolve.
+         * @return The name of the variable, or the empty string if it is unknown.
+         */
+        StringRef resolveName(const Value *pointer) const {
+            const Value *object = GetUnderlyingObject(pointer, function->getParent()->getDataLayout());
+
+            auto iterator = variables.find(object);
+            if (iterator != variables.end()) {
+                return iterator->second.first->getName();
+            }
+
+            if (auto *global = dyn_cast<GlobalVariable>(object)) {
+                SmallVector<DIGlobalVariableExpression *, 1> expressions;
+                global->getDebugInfo(expressions);
+
+                return expressions.empty() ? global->getName() : expressions.front()->getVariable()->getName();
+            }
+
+            return "";
+        }
+
+        /**
+         * Adds the variable a pointer is based on to the given set.
+         *
+         * @param pointer The pointer that is accessed.
+         * @param names The set to add the name to.
+         */
+        void recordAccess(const Value *pointer, StringSet<> &names) {
+            StringRef name = resolveName(pointer);
+
+            if (name.empty()) {
+                unresolved++;
+            } else {
+                names.insert(name);
+            }
+        }
+
+        /**
+         * Builds a Bloom filter of a set of names.
+         *
+         * @param names The names to add to the filter.
+         * @return The formatted filter.
+         */
+        static std::string formatFilter(const StringSet<> &names) {
+            NameFilter filter;
+
+            for (const auto &name : names) {
+                filter.insert(name.getKey());
+            }
+
+            return filter.format();
+        }
+
+        /**
+         * Determines the range of source lines of the instructions of the current function.
+         *
+         * @param function The function to determine the range of.
+         * @return The range formatted as first and last line, or ~ if no lines are known.
+         */
+        static std::string formatLines(const Function &function) {
+            unsigned first = ~0U, last = 0;
+
+            for (const Instruction &inst : instructions(function)) {
+                const DILocation *location = FunctionDebugInfo::getLocation(&inst);
+                unsigned line = location != nullptr ? location->getLine() : 0;
+
+                if (line != 0) {
+                    first = std::min(first, line);
+                    last = std::max(last, line);
+                }
+            }
+
+            return last != 0 ? formatv("{0}-{1}", first, last).str() : "~";
+        }
+    };
+
+}
+
+void CheckMergeSummary::getAnalysisUsage(AnalysisUsage &usage) const {
+    usage.setPreservesAll();
+    usage.addRequired<SourceVariableMapper>();
+    usage.addRequired<DebugInfoIndex>();
+}
+
+/**
+ * Scans the instructions of the function once and records the variables accessed and the functions called, without
+ * querying the memory dependence analysis.
+ *
+ * @param F The function to summarize.
+ */
+bool CheckMergeSummary::runOnFunction(Function &F) {
+    this->function = &F;
+    this->variables = getAnalysis<SourceVariableMapper>().getMapping();
+    this->reads.clear();
+    this->writes.clear();
+    this->calls.clear();
+    this->unresolved = 0;
+
+    for (Instruction &inst : instructions(F)) {
+        if (auto *load = dyn_cast<LoadInst>(&inst)) {
+            recordAccess(load->getPointerOperand(), reads);
+        } else if (auto *store = dyn_cast<StoreInst>(&inst)) {
+            recordAccess(store->getPointerOperand(), writes);
+        } else if (auto *transfer = dyn_cast<MemTransferInst>(&inst)) {
+            recordAccess(transfer->getRawSource(), reads);
+            recordAccess(transfer->getRawDest(), writes);
+        } else if (auto *memSet = dyn_cast<MemSetInst>(&inst)) {
+            recordAccess(memSet->getRawDest(), writes);
+        } else if (isa<IntrinsicInst>(&inst)) {
+            // Other intrinsics, such as debug information, do not access source variables
+            continue;
+        } else if (ImmutableCallSite callSite = ImmutableCallSite(&inst)) {
+            const Function *callee = callSite.getCalledFunction();
+
+            if (callee != nullptr) {
+                calls.insert(callee->getName());
+            } else {
+                unresolved++;
+            }
+
+            // The callee may access any variable passed by pointer
+            for (const Value *argument : callSite.args()) {
+                if (!argument->getType()->isPointerTy()) {
+                    continue;
+                }
+
+                StringRef name = resolveName(argument);
+
+                if (name.empty()) {
+                    unresolved++;
+                } else {
+                    reads.insert(name);
+
+                    if (!callSite.onlyReadsMemory()) {
+                        writes.insert(name);
+                    }
+                }
+            }
+        } else if (inst.mayReadOrWriteMemory()) {
+            // Atomic and other memory instructions are left to the full analysis
+            unresolved++;
+        }
+    }
+
+    // Write to file
+    if (this->output != nullptr) {
+        const DebugInfoIndex &debugInfo = getAnalysis<DebugInfoIndex>();
+        const DISubprogram *subprogram = debugInfo.getSubprogram(&F);
+
+        *output << formatv(
+                "function.{0}:\n"
+                "  name: \"{1}\"\n"
+                "  lines: \"{2}\"\n"
+                "  reads: \"{3}\"\n"
+                "  writes: \"{4}\"\n"
+                "  calls: \"{5}\"\n"
+                "  unresolved: {6}\n",
+                F.getName(),
+                subprogram != nullptr ? subprogram->getName() : F.getName(),
+                formatLines(F),
+                formatFilter(reads),
+                formatFilter(writes),
+                formatFilter(calls),
+                unresolved
+        ).str();
+    }
+
+    // No modifications so return false
+    return false;
+}
+
+void CheckMergeSummary::print(raw_ostream &os, const Module *module) const {
+    std::ostringstream out;
+
+    out << formatv("Reads:           {0}", this->reads.size()).str() << '\n';
+    out << formatv("Writes:          {0}", this->writes.size()).str() << '\n';
+    out << formatv("Calls:           {0}", this->calls.size()).str() << '\n';
+    out << formatv("Unresolved:      {0}", this->unresolved).str() << '\n';
+    out << '\n';
+    out << formatv("Written CheckMerge summary to file {0}", this->filename).str();
+    os << out.str() << '\n';
+}
+
+bool CheckMergeSummary::doInitialization(Module &module) {
+    if (SummaryFilename.empty()) {
+        const std::string &basename = module.getSourceFileName();
+        this->filename = basename.substr(0, basename.find_last_of('.')) + ".ll.cms";
+    } else {
+        this->filename = SummaryFilename;
+    }
+
+    if (this->filename == "-") {
+        this->output = &std::cout;
+    } else {
+        this->fileStream.open(filename);
+        this->output = this->fileStream.is_open() ? &this->fileStream : nullptr;
+    }
+
+    return false;
+}
+
+bool CheckMergeSummary::doFinalization(Module &module) {
+    if (this->output != nullptr) {
+        this->output->flush();
+        this->output = nullptr;
+    }
+
+    if (this->fileStream.is_open()) {
+        this->fileStream.close();
+    }
+
+    return false;
+}
+
+char CheckMergeSummary::ID = 0;
+
+static RegisterPass<CheckMergeSummary> CheckMergeSummaryPass("checkmerge-summary", "CheckMerge Summary", false, true);
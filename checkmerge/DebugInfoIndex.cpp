@@ -0,0 +1,99 @@
+/**
+ * @file DebugInfoIndex.cpp
+ * @author Jan-Jelle Kester
+ *
+ * LLVM analysis pass that walks the debug information of a module once and stores it in compact tables that can be
+ * queried by the other passes.
+ */
+#include "DebugInfoIndex.h"
+
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FormatVariadic.h>
+
+using namespace llvm;
+
+// Dependencies and behavior of this analysis
+void DebugInfoIndex::getAnalysisUsage(AnalysisUsage &usage) const {
+    usage.setPreservesAll();
+}
+
+void DebugInfoIndex::insertScope(const DIScope *scope) {
+    if (scope != nullptr) {
+        scopes.insert(scope);
+        files.insert(scope->getFile());
+    }
+}
+
+/**
+ * Iterates over the instructions of every function in the module once and records the subprograms, scopes, files and
+ * variables that are referenced, including the scopes of the source locations of the instructions.
+ *
+ * @param module The module to analyze.
+ */
+bool DebugInfoIndex::runOnModule(Module &module) {
+    for (const Function &function : module) {
+        FunctionDebugInfo &info = functions[&function];
+
+        // Save subprogram
+        if (const DISubprogram *subprogram = function.getSubprogram()) {
+            info.subprogram = subprograms.insert(subprogram);
+            insertScope(subprogram);
+        }
+
+        for (const Instruction &inst : instructions(function)) {
+            // Save the scope of the location, the location itself stays available on the instruction
+            if (const DILocation *location = inst.getDebugLoc().get()) {
+                insertScope(location->getScope());
+            }
+
+            // Save variable if the instruction declares its address
+            if (auto *dbgInst = dyn_cast<DbgInfoIntrinsic>(&inst)) {
+                const DILocalVariable *sourceVar = dbgInst->getVariable();
+                variables.insert(sourceVar);
+                insertScope(sourceVar->getScope());
+
+                if (dbgInst->isAddressOfVariable()) {
+                    // Use instruction debug location since this is more accurate
+                    info.variables[dbgInst->getVariableLocation()] = SourceVariable(sourceVar, &inst.getDebugLoc());
+                }
+            }
+        }
+    }
+
+    // We do not modify anything, so return false
+    return false;
+}
+
+void DebugInfoIndex::print(raw_ostream &os, const Module *) const {
+    os << formatv("Found {0} files, {1} scopes, {2} subprograms and {3} variables",
+                  files.size(), scopes.size(), subprograms.size(), variables.size()) << '\n';
+
+    for (unsigned id = 0; id < subprograms.size(); id++) {
+        const DISubprogram *subprogram = subprograms.get(id);
+
+        os << formatv("  Subprogram {0} [{1}] @ file {2}:{3}",
+                      id, subprogram->getName(), files.getId(subprogram->getFile()), subprogram->getLine()) << '\n';
+    }
+
+    for (unsigned id = 0; id < files.size(); id++) {
+        os << formatv("  File {0} [{1}]", id, files.get(id)->getFilename()) << '\n';
+    }
+}
+
+const FunctionDebugInfo *DebugInfoIndex::lookup(const Function *function) const {
+    auto iterator = functions.find(function);
+
+    return iterator != functions.end() ? &iterator->second : nullptr;
+}
+
+const DISubprogram *DebugInfoIndex::getSubprogram(const Function *function) const {
+    const FunctionDebugInfo *info = lookup(function);
+
+    return info != nullptr ? subprograms.get(info->subprogram) : nullptr;
+}
+
+char DebugInfoIndex::ID = 0;
+
+static RegisterPass<DebugInfoIndex> DebugInfoIndexPass("checkmerge-debuginfo", "CheckMerge Debug Information Index", false, true);
@@ -0,0 +1,171 @@
+/**
+ * @file DebugInfoIndex.h
+ * @author Jan-Jelle Kester
+ *
+ * Definition of a LLVM analysis pass that walks the debug information of a module once and stores it in compact tables
+ * that can be queried by the other passes.
+ */
+#ifndef CHECKMERGE_DEBUGINFOINDEX_H
+#define CHECKMERGE_DEBUGINFOINDEX_H
+
+#include <vector>
+#include <llvm/Pass.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/DebugLoc.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+
+using namespace llvm;
+
+// A source variable with the debug location of the instruction
+typedef std::pair<const DILocalVariable *, const DebugLoc *> SourceVariable;
+// A map between arbitrary values and a source variable
+typedef DenseMap<const Value *, SourceVariable> SourceVariableMap;
+
+/**
+ * A table of debug information nodes of a single kind, which assigns a dense identifier to every node.
+ */
+template<typename T>
+class DebugInfoTable {
+    std::vector<const T *> nodes;
+    DenseMap<const T *, unsigned> ids;
+
+public:
+
+    // Identifier of absent nodes
+    static const unsigned NoId = ~0U;
+
+    /**
+     * Adds the node to the table if it is not yet present.
+     *
+     * @param node The node to add, may be nullptr.
+     * @return The identifier of the node, or NoId if the node is nullptr.
+     */
+    unsigned insert(const T *node) {
+        if (node == nullptr) {
+            return NoId;
+        }
+
+        auto result = ids.insert(std::make_pair(node, static_cast<unsigned>(nodes.size())));
+
+        if (result.second) {
+            nodes.push_back(node);
+        }
+
+        return result.first->second;
+    }
+
+    /**
+     * @param node The node to look up.
+     * @return The identifier of the node, or NoId if the node is not part of the table.
+     */
+    unsigned getId(const T *node) const {
+        auto iterator = ids.find(node);
+        return iterator != ids.end() ? iterator->second : NoId;
+    }
+
+    /**
+     * @param id The identifier to look up.
+     * @return The node with the given identifier, or nullptr if the identifier is NoId.
+     */
+    const T *get(unsigned id) const {
+        return id != NoId ? nodes[id] : nullptr;
+    }
+
+    size_t size() const {
+        return nodes.size();
+    }
+
+    void clear() {
+        nodes.clear();
+        ids.clear();
+    }
+};
+
+/**
+ * Debug information of a single function.
+ */
+struct FunctionDebugInfo {
+    // Identifier of the subprogram of the function, NoId if there is no debug information
+    unsigned subprogram = DebugInfoTable<DISubprogram>::NoId;
+    // The source variables of which the address is known
+    SourceVariableMap variables;
+
+    /**
+     * The location is stored on the instruction itself, so it is read from there instead of being copied into a table.
+     *
+     * @param inst The instruction to look up.
+     * @return The source location of the instruction, or nullptr if it has none.
+     */
+    static const DILocation *getLocation(const Instruction *inst) {
+        return inst->getDebugLoc().get();
+    }
+};
+
+/**
+ * Analysis pass which collects the subprograms, local variables, scopes and files of a module, including the scopes of
+ * the source locations of all instructions.
+ */
+struct DebugInfoIndex : public ModulePass {
+
+    DebugInfoTable<DIFile> files;
+    DebugInfoTable<DIScope> scopes;
+    DebugInfoTable<DISubprogram> subprograms;
+    DebugInfoTable<DILocalVariable> variables;
+
+    DenseMap<const Function *, FunctionDebugInfo> functions;
+
+    static char ID;
+
+    DebugInfoIndex() : ModulePass(ID) {};
+
+    // Pass implementation
+    bool runOnModule(Module &module) override;
+
+    // Printer
+    void print(raw_ostream &os, const Module *) const override;
+
+    // Clean up memory
+    void releaseMemory() override {
+        this->files.clear();
+        this->scopes.clear();
+        this->subprograms.clear();
+        this->variables.clear();
+        this->functions.clear();
+    }
+
+    // Define requirements and behavior
+    void getAnalysisUsage(AnalysisUsage &usage) const override;
+
+    /**
+     * @param function The function to look up.
+     * @return The debug information of the function, or nullptr if the function is not part of the index.
+     */
+    const FunctionDebugInfo *lookup(const Function *function) const;
+
+    /**
+     * @param function The function to look up.
+     * @return The subprogram of the function, or nullptr if it has none.
+     */
+    const DISubprogram *getSubprogram(const Function *function) const;
+
+    /**
+     * @param inst The instruction to look up.
+     * @return The source location of the instruction, or nullptr if it has none.
+     */
+    const DILocation *getLocation(const Instruction *inst) const {
+        return FunctionDebugInfo::getLocation(inst);
+    }
+
+private:
+
+    /**
+     * Adds the scope and its file to the tables.
+     *
+     * @param scope The scope to add, may be nullptr.
+     */
+    void insertScope(const DIScope *scope);
+};
+
+#endif //CHECKMERGE_DEBUGINFOINDEX_H
@@ -19,7 +19,9 @@ using namespace llvm;
 // Dependencies and behavior of this analysis
 void DependenceCollector::getAnalysisUsage(AnalysisUsage &usage) const {
     usage.setPreservesAll();
-    usage.addRequired<MemoryDependenceWrapperPass>();
+    // The dependencies are collected lazily, so the memory dependence results must live as long as this pass
+    usage.addRequiredTransitive<MemoryDependenceWrapperPass>();
+    usage.addRequired<DebugInfoIndex>();
 //    usage.addRequired<SourceVariableMapper>();
 }
 
@@ -39,11 +41,53 @@ Dependency DependenceCollector::buildDependency(MemDepResult result) {
     return {result.getInst(), type};
 }
 
-DependencyPair DependenceCollector::buildDependencyPair(Dependency dependency, const BasicBlock * block) {
-    return static_cast<DependencyPair>(std::make_pair(dependency, block));
+DependencyPair DependenceCollector::buildDependencyPair(Dependency dependency, const BasicBlock * block, AccessType type) {
+    return {dependency, block, static_cast<uint8_t>(type)};
 }
 
-std::string DependenceCollector::formatInst(const Instruction *inst) {
+// Memory access flags
+enum : unsigned {
+    ReadsMemory = 1,
+    WritesMemory = 2
+};
+
+unsigned DependenceCollector::classifyAccess(const Instruction *inst, AccessMap &accesses) {
+    auto result = accesses.insert(std::make_pair(inst, 0U));
+
+    if (result.second) {
+        result.first->second = (inst->mayReadFromMemory() ? ReadsMemory : 0U)
+                               | (inst->mayWriteToMemory() ? WritesMemory : 0U);
+    }
+
+    return result.first->second;
+}
+
+AccessType DependenceCollector::buildAccessType(unsigned access, Dependency dependency, AccessMap &accesses) {
+    const Instruction *depInst = dependency.getPointer();
+
+    if (depInst == nullptr) {
+        return AccessType::UnknownAccess;
+    }
+
+    unsigned depAccess = classifyAccess(depInst, accesses);
+
+    // Reads take precedence for the instruction, writes for its dependency
+    if (access & ReadsMemory) {
+        if (depAccess & WritesMemory) return AccessType::ReadAfterWrite;
+        if (depAccess & ReadsMemory) return AccessType::ReadAfterRead;
+        return AccessType::ReadAfterUnknown;
+    }
+
+    if (access & WritesMemory) {
+        if (depAccess & WritesMemory) return AccessType::WriteAfterWrite;
+        if (depAccess & ReadsMemory) return AccessType::WriteAfterRead;
+        return AccessType::WriteAfterUnknown;
+    }
+
+    return AccessType::UnknownAccess;
+}
+
+std::string DependenceCollector::formatInst(const Instruction *inst) const {
     // Initialize data variables
     std::string locStr, idStr;
 
@@ -60,24 +104,18 @@ std::string DependenceCollector::formatInst(const Instruction *inst) {
     }
 }
 
- std::string DependenceCollector::formatDebugLoc(const Instruction *inst) {
-    // Collect metadata
-    MDVector metadata;
-    inst->getAllMetadata(metadata);
-
-    for (auto &metapair : metadata) {
-        if (MDNode *node = metapair.second) {
-            // Fetch location
-            if (auto *location = dyn_cast<DILocation>(node)) {
-                return formatv("{0}:{1}:{2}", location->getFilename(), location->getLine(), location->getColumn());
-            }
+std::string DependenceCollector::formatDebugLoc(const Instruction *inst) const {
+    // Fetch location
+    if (this->debugInfo != nullptr) {
+        if (const DILocation *location = this->debugInfo->getLocation(inst)) {
+            return formatv("{0}:{1}:{2}", location->getFilename(), location->getLine(), location->getColumn());
         }
     }
 
     return "";
 }
 
-std::string DependenceCollector::formatDependencyType(const DependencyType type) {
+const char *DependenceCollector::formatDependencyType(const DependencyType type) {
     switch (type) {
         case DependencyType::NonFuncLocal: return "non-local";
         case DependencyType::Clobber: return "clobber";
@@ -86,21 +124,57 @@ std::string DependenceCollector::formatDependencyType(const DependencyType type)
     }
 }
 
+const char *DependenceCollector::formatAccessType(AccessType type) {
+    switch (type) {
+        case AccessType::ReadAfterRead: return "RAR";
+        case AccessType::ReadAfterWrite: return "RAW";
+        case AccessType::ReadAfterUnknown: return "RAU";
+        case AccessType::WriteAfterRead: return "WAR";
+        case AccessType::WriteAfterWrite: return "WAW";
+        case AccessType::WriteAfterUnknown: return "WAU";
+        default: return "Unknown";
+    }
+}
+
 /**
- * Iterates over the instructions in each function and queries the memory dependence analysis to find the memory
- * dependencies of each memory instruction.
+ * Prepares the analysis of a function. The dependencies are collected when they are first requested.
  *
  * @param function The function to analyze.
  */
 bool DependenceCollector::runOnFunction(Function &function) {
     // Set function pointer
     this->function = &function;
+    this->debugInfo = getAnalysis<DebugInfoIndex>().lookup(&function);
 
     // Get memory dependence results
-    MemoryDependenceResults &results = getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
+    this->memDep = &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
+
+    this->dependencies.clear();
+    this->collected = false;
+
+    // We do not modify anything, so return false
+    return false;
+}
+
+/**
+ * Iterates over the instructions in the function and queries the memory dependence analysis to find the memory
+ * dependencies of each memory instruction.
+ */
+void DependenceCollector::collect() const {
+    // Quit if already collected or if we don't know the function
+    if (this->collected || this->function == nullptr) {
+        return;
+    }
+
+    this->collected = true;
+
+    MemoryDependenceResults &results = *this->memDep;
+
+    // Memory access of every instruction, so each instruction is only classified once
+    AccessMap accesses;
 
     // Iterate over instructions in function
-    for (auto &I : instructions(function)) {
+    for (auto &I : instructions(*function)) {
         Instruction *inst = &I;
 
         // Continue if this instruction does not do anything with memory
@@ -108,13 +182,16 @@ bool DependenceCollector::runOnFunction(Function &function) {
             continue;
         }
 
+        unsigned access = classifyAccess(inst, accesses);
+
         // Get dependence result for the instruction
         MemDepResult result = results.getDependency(inst);
 
         if (!result.isNonLocal()) {
             // If the dependency is local
             Dependency dependency = buildDependency(result);
-            dependencies[inst].insert(buildDependencyPair(dependency, static_cast<BasicBlock *>(nullptr)));
+            dependencies[inst].insert(buildDependencyPair(dependency, static_cast<BasicBlock *>(nullptr),
+                                                          buildAccessType(access, dependency, accesses)));
         } else if (auto callSite = CallSite(inst)) {
             // If the dependency is a call or invoke (so not local)
             const MemoryDependenceResults::NonLocalDepInfo &info = results.getNonLocalCallDependency(callSite);
@@ -123,7 +200,8 @@ bool DependenceCollector::runOnFunction(Function &function) {
             for (const NonLocalDepEntry &entry : info) {
                 const MemDepResult &depResult = entry.getResult();
                 Dependency dependency = buildDependency(depResult);
-                dependencies[inst].insert(buildDependencyPair(dependency, entry.getBB()));
+                dependencies[inst].insert(buildDependencyPair(dependency, entry.getBB(),
+                                                              buildAccessType(access, dependency, accesses)));
             }
         } else {
             // If the dependency is load, store or argument (or other)
@@ -134,13 +212,11 @@ bool DependenceCollector::runOnFunction(Function &function) {
             for (const NonLocalDepResult &nonLocalDepResult : depResults) {
                 const MemDepResult &depResult = nonLocalDepResult.getResult();
                 Dependency dependency = buildDependency(depResult);
-                dependencies[inst].insert(buildDependencyPair(dependency, nonLocalDepResult.getBB()));
+                dependencies[inst].insert(buildDependencyPair(dependency, nonLocalDepResult.getBB(),
+                                                              buildAccessType(access, dependency, accesses)));
             }
         }
     }
-
-    // We do not modify anything, so return false
-    return false;
 }
 
 void DependenceCollector::print(raw_ostream &os, const Module *) const {
@@ -149,6 +225,8 @@ void DependenceCollector::print(raw_ostream &os, const Module *) const {
         return;
     }
 
+    collect();
+
     // Get variable mapping
 //    SourceVariableMap mapping = getAnalysis<SourceVariableMapper>().getMapping();
 
@@ -221,6 +299,8 @@ void DependenceCollector::printInstDeps(raw_ostream &os, const Instruction *inst
 }
 
 DependencyMap DependenceCollector::getDependencies() const {
+    collect();
+
     return dependencies;
 }
 
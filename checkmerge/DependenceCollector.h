@@ -15,6 +15,7 @@
 #include <llvm/IR/Metadata.h>
 #include <llvm/ADT/SetVector.h>
 #include <llvm/Analysis/MemoryDependenceAnalysis.h>
+#include "DebugInfoIndex.h"
 
 using namespace llvm;
 
@@ -28,11 +29,63 @@ enum DependencyType {
     Unknown /** All other cases. */
 };
 
+/**
+ * Types of memory access of a dependency, being the access of the instruction after the access of its dependency.
+ */
+enum AccessType {
+    UnknownAccess = 0, /** The dependency is not on an instruction. */
+    ReadAfterRead, /** Reads memory read before. */
+    ReadAfterWrite, /** Reads memory written before. */
+    ReadAfterUnknown, /** Reads memory not accessed by the dependency, e.g., an allocation. */
+    WriteAfterRead, /** Writes memory read before. */
+    WriteAfterWrite, /** Writes memory written before. */
+    WriteAfterUnknown /** Writes memory not accessed by the dependency, e.g., an allocation. */
+};
+
 // The instruction that is dependent on including the type of dependency
 typedef PointerIntPair<const Instruction *, 2, DependencyType> Dependency;
-// The (optional) dependency (nullptr if  with an optional block (nullptr if the dependency is local to the block of
-// the instruction).
-typedef std::pair<Dependency, const BasicBlock *> DependencyPair;
+
+/**
+ * The (optional) dependency with an optional block (nullptr if the dependency is local to the block of the
+ * instruction), including the type of memory access.
+ */
+struct DependencyPair {
+    Dependency first;
+    const BasicBlock *second;
+    uint8_t access;
+
+    AccessType getAccessType() const {
+        return static_cast<AccessType>(access);
+    }
+
+    bool operator==(const DependencyPair &other) const {
+        return first == other.first && second == other.second && access == other.access;
+    }
+};
+
+namespace llvm {
+    template<>
+    struct DenseMapInfo<DependencyPair> {
+        typedef DenseMapInfo<std::pair<Dependency, const BasicBlock *>> PairInfo;
+
+        static inline DependencyPair getEmptyKey() {
+            return {DenseMapInfo<Dependency>::getEmptyKey(), nullptr, 0};
+        }
+
+        static inline DependencyPair getTombstoneKey() {
+            return {DenseMapInfo<Dependency>::getTombstoneKey(), nullptr, 0};
+        }
+
+        static unsigned getHashValue(const DependencyPair &pair) {
+            return PairInfo::getHashValue(std::make_pair(pair.first, pair.second)) * 37U + pair.access;
+        }
+
+        static bool isEqual(const DependencyPair &lhs, const DependencyPair &rhs) {
+            return lhs == rhs;
+        }
+    };
+}
+
 // A set of dependencies
 typedef SmallSetVector<DependencyPair, 4> DependencySet;
 // The dependencies per instruction
@@ -43,16 +96,20 @@ typedef DenseMap<const Instruction *, DependencySet> DependencyMap;
  */
 struct DependenceCollector : public FunctionPass {
 
-    // Metadata
-    typedef SmallVector<std::pair<unsigned, MDNode *>, 4> MDVector;
-
-    DependencyMap dependencies;
+    // Collected on first use, so runs that do not need the dependencies do not query the memory dependence analysis
+    mutable DependencyMap dependencies;
+    mutable bool collected;
     Function *function;
+    const FunctionDebugInfo *debugInfo;
+    MemoryDependenceResults *memDep;
 
     static char ID;
 
     DependenceCollector() : FunctionPass(ID) {
+        this->collected = false;
         this->function = nullptr;
+        this->debugInfo = nullptr;
+        this->memDep = nullptr;
     };
 
     // Pass implementation
@@ -64,7 +121,10 @@ struct DependenceCollector : public FunctionPass {
     // Clean up memory
     void releaseMemory() override {
         this->dependencies.clear();
+        this->collected = false;
         this->function = nullptr;
+        this->debugInfo = nullptr;
+        this->memDep = nullptr;
     }
 
     // Define requirements and behavior
@@ -75,8 +135,25 @@ struct DependenceCollector : public FunctionPass {
      */
     DependencyMap getDependencies() const;
 
+    /**
+     * String formats the type of memory access of a dependency.
+     *
+     * @param type The type to format.
+     * @return A static token representing the type.
+     */
+    static const char *formatAccessType(AccessType type);
+
 private:
 
+    // Memory access flags per instruction
+    typedef DenseMap<const Instruction *, unsigned> AccessMap;
+
+    /**
+     * Queries the memory dependence analysis for the dependencies of each memory instruction, if this has not been done
+     * for the current function yet.
+     */
+    void collect() const;
+
     /**
      * Builds a combination of the instruction and its dependency type from a dependency result.
      *
@@ -89,8 +166,28 @@ private:
      *
      * @param dependency The dependency to optionally pair with a block.
      * @param block The block to optionally pair with a dependency.
+     * @param type The type of memory access of the dependency.
+     */
+    static DependencyPair buildDependencyPair(Dependency dependency, const BasicBlock * block, AccessType type);
+
+    /**
+     * Determines whether the instruction reads and/or writes memory, computing this only once per instruction.
+     *
+     * @param inst The instruction to classify.
+     * @param accesses The previously classified instructions.
+     * @return The memory access flags of the instruction.
+     */
+    static unsigned classifyAccess(const Instruction *inst, AccessMap &accesses);
+
+    /**
+     * Determines the type of memory access of a dependency.
+     *
+     * @param access The memory access flags of the dependent instruction.
+     * @param dependency The dependency of the instruction.
+     * @param accesses The previously classified instructions.
+     * @return The type of memory access of the dependency.
      */
-    static DependencyPair buildDependencyPair(Dependency dependency, const BasicBlock * block);
+    static AccessType buildAccessType(unsigned access, Dependency dependency, AccessMap &accesses);
 
     /**
      * String formats the given instruction with some debug information.
@@ -98,7 +195,7 @@ private:
      * @param inst The instruction to format.
      * @return A string representation of the instruction.
      */
-    static std::string formatInst(const Instruction *inst);
+    std::string formatInst(const Instruction *inst) const;
 
     /**
      * String formats the debug location of the given instruction. May return the empty string if no location is
@@ -107,7 +204,7 @@ private:
      * @param inst The instruction to format the location of.
      * @return A string representation of the original location of the instruction.
      */
-    static std::string formatDebugLoc(const Instruction *inst);
+    std::string formatDebugLoc(const Instruction *inst) const;
 
     /**
      * String formats the type of a dependency.
@@ -115,7 +212,7 @@ private:
      * @param type The type to foramt.
      * @return A string representation of the type.
      */
-    static std::string formatDependencyType(const DependencyType type);
+    static const char *formatDependencyType(const DependencyType type);
 
     /**
      * Prints the dependencies of an instruction.
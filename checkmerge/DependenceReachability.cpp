@@ -0,0 +1,365 @@
+/**
+ * @file DependenceReachability.cpp
+ * @author Jan-Jelle Kester
+ *
+ * LLVM analysis pass that precomputes which instructions transitively depend on each other, so such questions can be
+ * answered without searching the dependency graph.
+ */
+#include "DependenceReachability.h"
+
+#include <algorithm>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FormatVariadic.h>
+
+using namespace llvm;
+
+static cl::opt<unsigned> ReachabilityLimit(
+        "checkmerge-reach-limit",
+        cl::desc("Maximum number of reachability intervals per function, larger functions are searched instead"),
+        cl::init(1U << 22)
+);
+
+const unsigned DependenceReachability::NoComponent;
+
+// Dependencies and behavior of this analysis
+void DependenceReachability::getAnalysisUsage(AnalysisUsage &usage) const {
+    usage.setPreservesAll();
+    usage.addRequired<DependenceCollector>();
+}
+
+/**
+ * Builds the dependency graph of the function, condenses it into strongly connected components and computes the set of
+ * reachable components of each component.
+ *
+ * @param function The function to analyze.
+ */
+bool DependenceReachability::runOnFunction(Function &function) {
+    releaseMemory();
+    this->function = &function;
+
+    DependencyMap dependencies = getAnalysis<DependenceCollector>().getDependencies();
+
+    // Find the instructions that take part in the graph
+    SmallPtrSet<const Instruction *, 32> participants;
+
+    for (const auto &entry : dependencies) {
+        for (const DependencyPair &dependencyPair : entry.second) {
+            if (const Instruction *depInst = dependencyPair.first.getPointer()) {
+                participants.insert(entry.first);
+                participants.insert(depInst);
+            }
+        }
+    }
+
+    // Number the nodes in instruction order, so the result does not depend on the order of the map
+    std::vector<const Instruction *> nodes;
+    DenseMap<const Instruction *, unsigned> nodeIds;
+
+    for (const Instruction &inst : instructions(function)) {
+        if (participants.count(&inst)) {
+            nodeIds[&inst] = nodes.size();
+            nodes.push_back(&inst);
+        }
+    }
+
+    // Edges point from an instruction to the instructions it depends on
+    std::vector<SmallVector<unsigned, 4>> successors(nodes.size());
+
+    for (unsigned node = 0; node < nodes.size(); node++) {
+        auto iterator = dependencies.find(nodes[node]);
+
+        if (iterator == dependencies.end()) {
+            continue;
+        }
+
+        for (const DependencyPair &dependencyPair : iterator->second) {
+            if (const Instruction *depInst = dependencyPair.first.getPointer()) {
+                successors[node].push_back(nodeIds[depInst]);
+            }
+        }
+    }
+
+    std::vector<unsigned> component;
+    unsigned componentCount = condense(successors, component);
+
+    for (unsigned node = 0; node < nodes.size(); node++) {
+        components[nodes[node]] = component[node];
+    }
+
+    // Group the nodes by component
+    std::vector<SmallVector<unsigned, 2>> members(componentCount);
+
+    for (unsigned node = 0; node < nodes.size(); node++) {
+        members[component[node]].push_back(node);
+    }
+
+    // Build the condensed graph, without duplicate edges
+    successorStart.assign(1, 0);
+    successorList.clear();
+
+    for (unsigned current = 0; current < componentCount; current++) {
+        size_t first = successorList.size();
+
+        for (unsigned node : members[current]) {
+            for (unsigned successor : successors[node]) {
+                if (component[successor] != current) {
+                    successorList.push_back(component[successor]);
+                }
+            }
+        }
+
+        std::sort(successorList.begin() + first, successorList.end());
+        successorList.erase(std::unique(successorList.begin() + first, successorList.end()), successorList.end());
+        successorStart.push_back(successorList.size());
+    }
+
+    std::vector<unsigned> low;
+    numberComponents(low);
+    labelled = buildLabels(low, ReachabilityLimit);
+
+    // We do not modify anything, so return false
+    return false;
+}
+
+unsigned DependenceReachability::condense(const std::vector<SmallVector<unsigned, 4>> &successors,
+                                          std::vector<unsigned> &component) {
+    const unsigned unvisited = ~0U;
+    unsigned nodeCount = successors.size();
+    unsigned counter = 0, componentCount = 0;
+
+    std::vector<unsigned> index(nodeCount, unvisited), lowLink(nodeCount, 0);
+    std::vector<bool> onStack(nodeCount, false);
+    std::vector<unsigned> stack;
+    // Nodes being visited with the position of the next successor to visit
+    std::vector<std::pair<unsigned, unsigned>> work;
+
+    component.assign(nodeCount, NoComponent);
+
+    for (unsigned root = 0; root < nodeCount; root++) {
+        if (index[root] != unvisited) {
+            continue;
+        }
+
+        work.emplace_back(root, 0);
+
+        while (!work.empty()) {
+            unsigned node = work.back().first;
+            unsigned edge = work.back().second;
+
+            // Visit node for the first time
+            if (index[node] == unvisited) {
+                index[node] = lowLink[node] = counter++;
+                stack.push_back(node);
+                onStack[node] = true;
+            }
+
+            if (edge < successors[node].size()) {
+                // Continue with the next successor
+                unsigned next = successors[node][edge];
+                work.back().second++;
+
+                if (index[next] == unvisited) {
+                    work.emplace_back(next, 0);
+                } else if (onStack[next]) {
+                    lowLink[node] = std::min(lowLink[node], index[next]);
+                }
+            } else {
+                // All successors visited, so finish the node
+                work.pop_back();
+
+                if (!work.empty()) {
+                    unsigned parent = work.back().first;
+                    lowLink[parent] = std::min(lowLink[parent], lowLink[node]);
+                }
+
+                // Pop the component if the node is its root
+                if (lowLink[node] == index[node]) {
+                    unsigned member;
+
+                    do {
+                        member = stack.back();
+                        stack.pop_back();
+                        onStack[member] = false;
+                        component[member] = componentCount;
+                    } while (member != node);
+
+                    componentCount++;
+                }
+            }
+        }
+    }
+
+    return componentCount;
+}
+
+void DependenceReachability::numberComponents(std::vector<unsigned> &low) {
+    unsigned componentCount = getNumComponents();
+    unsigned counter = 0;
+
+    std::vector<bool> visited(componentCount, false);
+    // Components being visited with the position of the next successor to visit
+    std::vector<std::pair<unsigned, unsigned>> work;
+
+    postOrder.assign(componentCount, 0);
+    low.assign(componentCount, 0);
+
+    // Components without predecessors have the highest numbers, so start there
+    for (unsigned root = componentCount; root-- > 0;) {
+        if (visited[root]) {
+            continue;
+        }
+
+        visited[root] = true;
+        low[root] = counter;
+        work.emplace_back(root, successorStart[root]);
+
+        while (!work.empty()) {
+            unsigned current = work.back().first;
+            unsigned edge = work.back().second;
+
+            if (edge < successorStart[current + 1]) {
+                // Continue with the next successor, which becomes a child in the spanning forest if not yet visited
+                unsigned next = successorList[edge];
+                work.back().second++;
+
+                if (!visited[next]) {
+                    visited[next] = true;
+                    low[next] = counter;
+                    work.emplace_back(next, successorStart[next]);
+                }
+            } else {
+                // All successors visited, so the subtree is numbered from low up to this component
+                postOrder[current] = counter++;
+                work.pop_back();
+            }
+        }
+    }
+}
+
+bool DependenceReachability::buildLabels(const std::vector<unsigned> &low, size_t limit) {
+    unsigned componentCount = getNumComponents();
+    SmallVector<Interval, 8> pending;
+
+    labelStart.assign(1, 0);
+    intervals.clear();
+
+    // Components only reach lower numbered components, so their labels are complete when they are needed
+    for (unsigned current = 0; current < componentCount; current++) {
+        pending.clear();
+        pending.push_back(Interval(low[current], postOrder[current]));
+
+        for (unsigned edge = successorStart[current]; edge < successorStart[current + 1]; edge++) {
+            unsigned successor = successorList[edge];
+            pending.append(intervals.begin() + labelStart[successor], intervals.begin() + labelStart[successor + 1]);
+        }
+
+        // Merge overlapping and adjacent intervals
+        std::sort(pending.begin(), pending.end());
+        size_t first = intervals.size();
+
+        for (const Interval &interval : pending) {
+            if (intervals.size() > first && interval.first <= intervals.back().second + 1) {
+                intervals.back().second = std::max(intervals.back().second, interval.second);
+            } else {
+                intervals.push_back(interval);
+            }
+        }
+
+        if (intervals.size() > limit) {
+            labelStart.clear();
+            intervals.clear();
+            return false;
+        }
+
+        labelStart.push_back(intervals.size());
+    }
+
+    return true;
+}
+
+bool DependenceReachability::search(unsigned from, unsigned to) const {
+    std::vector<bool> visited(getNumComponents(), false);
+    std::vector<unsigned> work(1, from);
+    visited[from] = true;
+
+    while (!work.empty()) {
+        unsigned current = work.back();
+        work.pop_back();
+
+        if (current == to) {
+            return true;
+        }
+
+        for (unsigned edge = successorStart[current]; edge < successorStart[current + 1]; edge++) {
+            unsigned next = successorList[edge];
+
+            // Components only reach lower numbered components
+            if (!visited[next] && next >= to) {
+                visited[next] = true;
+                work.push_back(next);
+            }
+        }
+    }
+
+    return false;
+}
+
+void DependenceReachability::print(raw_ostream &os, const Module *) const {
+    // Quit if we don't know the function
+    if (this->function == nullptr) {
+        return;
+    }
+
+    os << formatv("Function [{0}] has {1} instructions in {2} components",
+                  function->getName(), components.size(), getNumComponents()) << '\n';
+
+    if (labelled) {
+        os << formatv("  Labelled with {0} intervals", intervals.size()) << '\n';
+    } else {
+        os << "  Not labelled, the interval limit was exceeded" << '\n';
+    }
+}
+
+bool DependenceReachability::reaches(const Instruction *from, const Instruction *to) const {
+    if (from == to) {
+        return true;
+    }
+
+    unsigned fromComponent = getComponent(from), toComponent = getComponent(to);
+
+    if (fromComponent == NoComponent || toComponent == NoComponent) {
+        return false;
+    }
+
+    if (!labelled) {
+        return search(fromComponent, toComponent);
+    }
+
+    // Find the last interval starting at or before the post-order number of the target
+    unsigned position = postOrder[toComponent];
+    auto begin = intervals.begin() + labelStart[fromComponent], end = intervals.begin() + labelStart[fromComponent + 1];
+    auto iterator = std::upper_bound(begin, end, position, [](unsigned value, const Interval &interval) {
+        return value < interval.first;
+    });
+
+    return iterator != begin && std::prev(iterator)->second >= position;
+}
+
+unsigned DependenceReachability::getComponent(const Instruction *inst) const {
+    auto iterator = components.find(inst);
+
+    return iterator != components.end() ? iterator->second : NoComponent;
+}
+
+unsigned DependenceReachability::getNumComponents() const {
+    return successorStart.empty() ? 0 : successorStart.size() - 1;
+}
+
+bool DependenceReachability::isLabelled() const {
+    return labelled;
+}
+
+char DependenceReachability::ID = 0;
+
+static RegisterPass<DependenceReachability> DependenceReachabilityPass("checkmerge-reach", "CheckMerge Dependence Reachability", false, true);
@@ -0,0 +1,147 @@
+/**
+ * @file DependenceReachability.h
+ * @author Jan-Jelle Kester
+ *
+ * Definition of a LLVM analysis pass that precomputes which instructions transitively depend on each other, so such
+ * questions can be answered without searching the dependency graph.
+ */
+#ifndef CHECKMERGE_DEPENDENCEREACHABILITY_H
+#define CHECKMERGE_DEPENDENCEREACHABILITY_H
+
+#include <vector>
+#include <llvm/Pass.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Instruction.h>
+#include "DependenceCollector.h"
+
+using namespace llvm;
+
+// A closed range of post-order numbers
+typedef std::pair<unsigned, unsigned> Interval;
+
+/**
+ * Analysis pass which, for every function, condenses the dependency graph into its strongly connected components and
+ * labels every component with the components it can reach.
+ *
+ * The labels are interval labels: the components are numbered in post-order of a spanning forest of the condensed
+ * graph, so the components reachable through tree edges form a single interval. Every label is the merged list of
+ * intervals of a component and of its successors. Graphs that are mostly trees or chains, which is common at -O0,
+ * therefore need only a few intervals per component, and a query is a binary search in one label.
+ *
+ * Labels can still grow with the square of the number of components for densely connected graphs. If labelling a
+ * function would exceed the interval limit, the labels are dropped and queries search the condensed graph instead.
+ */
+struct DependenceReachability : public FunctionPass {
+
+    // Component of instructions that are not part of the dependency graph
+    static const unsigned NoComponent = ~0U;
+
+    // The component of every instruction in the dependency graph
+    DenseMap<const Instruction *, unsigned> components;
+    // The successors of every component in the condensed graph, stored consecutively per component
+    std::vector<unsigned> successorStart;
+    std::vector<unsigned> successorList;
+    // The post-order number of every component
+    std::vector<unsigned> postOrder;
+    // The intervals of reachable post-order numbers of every component, stored consecutively per component
+    std::vector<unsigned> labelStart;
+    std::vector<Interval> intervals;
+    // Whether the labels are available, false if the function exceeded the interval limit
+    bool labelled;
+    Function *function;
+
+    static char ID;
+
+    DependenceReachability() : FunctionPass(ID) {
+        this->labelled = false;
+        this->function = nullptr;
+    };
+
+    // Pass implementation
+    bool runOnFunction(Function &function) override;
+
+    // Printer
+    void print(raw_ostream &os, const Module *) const override;
+
+    // Clean up memory
+    void releaseMemory() override {
+        this->components.clear();
+        this->successorStart.clear();
+        this->successorList.clear();
+        this->postOrder.clear();
+        this->labelStart.clear();
+        this->intervals.clear();
+        this->labelled = false;
+        this->function = nullptr;
+    }
+
+    // Define requirements and behavior
+    void getAnalysisUsage(AnalysisUsage &usage) const override;
+
+    /**
+     * Determines whether an instruction transitively depends on another instruction. Every instruction reaches itself.
+     *
+     * @param from The dependent instruction.
+     * @param to The instruction that may be depended on.
+     * @return Whether there is a path of dependencies from the first to the second instruction.
+     */
+    bool reaches(const Instruction *from, const Instruction *to) const;
+
+    /**
+     * @param inst The instruction to look up.
+     * @return The strongly connected component of the instruction, or NoComponent if it has no dependencies and no
+     * instructions depend on it.
+     */
+    unsigned getComponent(const Instruction *inst) const;
+
+    /**
+     * @return The number of strongly connected components in the dependency graph.
+     */
+    unsigned getNumComponents() const;
+
+    /**
+     * @return Whether the reachability labels are available, so queries do not search the graph.
+     */
+    bool isLabelled() const;
+
+private:
+
+    /**
+     * Assigns every node to its strongly connected component using Tarjan's algorithm. The components are numbered in
+     * reverse topological order, so components only reach components with a lower number.
+     *
+     * @param successors The successors of every node.
+     * @param component Set to the component of every node.
+     * @return The number of components.
+     */
+    static unsigned condense(const std::vector<SmallVector<unsigned, 4>> &successors, std::vector<unsigned> &component);
+
+    /**
+     * Numbers the components in post-order of a depth-first spanning forest of the condensed graph.
+     *
+     * @param low Set to the lowest post-order number in the spanning subtree of every component.
+     */
+    void numberComponents(std::vector<unsigned> &low);
+
+    /**
+     * Builds the interval labels of all components.
+     *
+     * @param low The lowest post-order number in the spanning subtree of every component.
+     * @param limit The maximum total number of intervals.
+     * @return Whether the labels fit within the limit.
+     */
+    bool buildLabels(const std::vector<unsigned> &low, size_t limit);
+
+    /**
+     * Determines whether a component reaches another component by searching the condensed graph.
+     *
+     * @param from The component to start from.
+     * @param to The component to find.
+     * @return Whether the second component is reachable from the first.
+     */
+    bool search(unsigned from, unsigned to) const;
+};
+
+#endif //CHECKMERGE_DEPENDENCEREACHABILITY_H
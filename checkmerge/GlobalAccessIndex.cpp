@@ -0,0 +1,174 @@
+/**
+ * @file GlobalAccessIndex.cpp
+ * @author Jan-Jelle Kester
+ *
+ * LLVM analysis pass that indexes, for the whole module, which instructions and functions read or write each global
+ * variable.
+ */
+#include "GlobalAccessIndex.h"
+
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/CallSite.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FormatVariadic.h>
+
+using namespace llvm;
+
+// Dependencies and behavior of this analysis
+void GlobalAccessIndex::getAnalysisUsage(AnalysisUsage &usage) const {
+    usage.setPreservesAll();
+}
+
+/**
+ * Scans every instruction in the module once and records the accesses of memory instructions whose pointer operand
+ * is based on a global variable, as well as the stores through which the address of a global escapes.
+ *
+ * @param module The module to analyze.
+ */
+bool GlobalAccessIndex::runOnModule(Module &module) {
+    // Create an entry for every global, so globals without accesses are part of the index as well
+    for (const GlobalVariable &global : module.globals()) {
+        GlobalAccessEntry &entry = globals[&global];
+
+        SmallVector<DIGlobalVariableExpression *, 1> expressions;
+        global.getDebugInfo(expressions);
+
+        if (!expressions.empty()) {
+            entry.variable = expressions.front()->getVariable();
+        }
+    }
+
+    // Iterate over all instructions in the module
+    for (const Function &function : module) {
+        for (const Instruction &inst : instructions(function)) {
+            // Continue if this instruction does not do anything with memory
+            if (!inst.mayReadOrWriteMemory()) {
+                continue;
+            }
+
+            if (auto *load = dyn_cast<LoadInst>(&inst)) {
+                recordAccess(load->getPointerOperand(), &inst, GlobalAccessKind::GlobalRead);
+            } else if (auto *store = dyn_cast<StoreInst>(&inst)) {
+                recordAccess(store->getPointerOperand(), &inst, GlobalAccessKind::GlobalWrite);
+
+                // Storing the address of a global lets the function access it through the stored pointer
+                if (store->getValueOperand()->getType()->isPointerTy()) {
+                    recordEscape(store->getValueOperand(), &inst);
+                }
+            } else if (auto *rmw = dyn_cast<AtomicRMWInst>(&inst)) {
+                recordAccess(rmw->getPointerOperand(), &inst, GlobalAccessKind::GlobalReadWrite);
+            } else if (auto *cmpXchg = dyn_cast<AtomicCmpXchgInst>(&inst)) {
+                recordAccess(cmpXchg->getPointerOperand(), &inst, GlobalAccessKind::GlobalReadWrite);
+            } else if (auto *transfer = dyn_cast<MemTransferInst>(&inst)) {
+                recordAccess(transfer->getRawDest(), &inst, GlobalAccessKind::GlobalWrite);
+                recordAccess(transfer->getRawSource(), &inst, GlobalAccessKind::GlobalRead);
+            } else if (auto *memSet = dyn_cast<MemSetInst>(&inst)) {
+                recordAccess(memSet->getRawDest(), &inst, GlobalAccessKind::GlobalWrite);
+            } else if (ImmutableCallSite callSite = ImmutableCallSite(&inst)) {
+                // The callee may access any global passed by pointer
+                GlobalAccessKind kind = callSite.onlyReadsMemory()
+                                        ? GlobalAccessKind::GlobalRead
+                                        : GlobalAccessKind::GlobalReadWrite;
+
+                for (const Value *argument : callSite.args()) {
+                    if (argument->getType()->isPointerTy()) {
+                        recordAccess(argument, &inst, kind);
+                    }
+                }
+            }
+        }
+    }
+
+    // We do not modify anything, so return false
+    return false;
+}
+
+void GlobalAccessIndex::recordAccess(const Value *pointer, const Instruction *inst, GlobalAccessKind kind) {
+    const DataLayout &layout = inst->getModule()->getDataLayout();
+    const Value *object = GetUnderlyingObject(pointer, layout);
+
+    if (const auto *global = dyn_cast<GlobalVariable>(object)) {
+        addAccess(global, inst, kind);
+    } else if (!isa<AllocaInst>(object)) {
+        // The pointer may point to any global, e.g., after it was loaded from memory
+        unresolved[inst->getFunction()]++;
+    }
+}
+
+void GlobalAccessIndex::recordEscape(const Value *value, const Instruction *inst) {
+    const DataLayout &layout = inst->getModule()->getDataLayout();
+
+    if (const auto *global = dyn_cast<GlobalVariable>(GetUnderlyingObject(value, layout))) {
+        addAccess(global, inst, GlobalAccessKind::GlobalReadWrite);
+    }
+}
+
+void GlobalAccessIndex::addAccess(const GlobalVariable *global, const Instruction *inst, GlobalAccessKind kind) {
+    GlobalAccessEntry &entry = globals[global];
+    entry.accesses.push_back(GlobalAccess(inst, kind));
+    entry.functions.insert(inst->getFunction());
+    entry.kinds |= kind;
+}
+
+const char *GlobalAccessIndex::formatAccessKind(unsigned kind) {
+    switch (kind) {
+        case GlobalAccessKind::GlobalRead: return "R";
+        case GlobalAccessKind::GlobalWrite: return "W";
+        case GlobalAccessKind::GlobalReadWrite: return "RW";
+        default: return "-";
+    }
+}
+
+void GlobalAccessIndex::print(raw_ostream &os, const Module *) const {
+    unsigned unresolvedCount = 0;
+
+    for (const auto &function : unresolved) {
+        unresolvedCount += function.second;
+    }
+
+    os << formatv("Found {0} globals, {1} accesses in {2} function(s) could not be resolved",
+                  globals.size(), unresolvedCount, unresolved.size()) << '\n';
+
+    // Print one row per access, or a single row for globals that are never accessed
+    for (const auto &global : globals) {
+        const GlobalAccessEntry &entry = global.second;
+        StringRef variableName = entry.variable != nullptr ? entry.variable->getName() : "~";
+
+        os << formatv("{0}\t{1}\t{2}\t{3} function(s)",
+                      global.first->getName(), variableName, formatAccessKind(entry.kinds), entry.functions.size())
+           << '\n';
+
+        for (const GlobalAccess &access : entry.accesses) {
+            const Instruction *inst = access.getPointer();
+            const DebugLoc &loc = inst->getDebugLoc();
+
+            os << formatv("  {0}\t{1}\t{2}\t{3}",
+                          formatAccessKind(access.getInt()),
+                          inst->getFunction()->getName(),
+                          inst->getOpcodeName(),
+                          bool(loc) ? formatv("{0}:{1}", loc.getLine(), loc.getCol()).str() : "~")
+               << '\n';
+        }
+    }
+}
+
+const GlobalAccessMap &GlobalAccessIndex::getGlobals() const {
+    return globals;
+}
+
+const GlobalAccessEntry *GlobalAccessIndex::lookup(const GlobalVariable *global) const {
+    auto iterator = globals.find(global);
+
+    return iterator != globals.end() ? &iterator->second : nullptr;
+}
+
+unsigned GlobalAccessIndex::getUnresolved(const Function *function) const {
+    return unresolved.lookup(function);
+}
+
+char GlobalAccessIndex::ID = 0;
+
+static RegisterPass<GlobalAccessIndex> GlobalAccessIndexPass("checkmerge-globals", "CheckMerge Global Variable Access", false, true);
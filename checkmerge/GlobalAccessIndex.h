@@ -0,0 +1,142 @@
+/**
+ * @file GlobalAccessIndex.h
+ * @author Jan-Jelle Kester
+ *
+ * Definition of a LLVM analysis pass that indexes, for the whole module, which instructions and functions read or
+ * write each global variable.
+ */
+#ifndef CHECKMERGE_GLOBALACCESSINDEX_H
+#define CHECKMERGE_GLOBALACCESSINDEX_H
+
+#include <llvm/Pass.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Instruction.h>
+
+using namespace llvm;
+
+/**
+ * Kinds of access an instruction can have on a global variable.
+ */
+enum GlobalAccessKind {
+    GlobalRead = 1, /** Reads from the global. */
+    GlobalWrite = 2, /** Writes to the global. */
+    GlobalReadWrite = GlobalRead | GlobalWrite /** Both reads from and writes to the global, e.g., an atomic update. */
+};
+
+// An instruction accessing a global including the kind of access
+typedef PointerIntPair<const Instruction *, 2, GlobalAccessKind> GlobalAccess;
+
+/**
+ * All known accesses of a single global variable.
+ */
+struct GlobalAccessEntry {
+    // The source variable of the global, nullptr if there is no debug information
+    const DIGlobalVariable *variable = nullptr;
+    // The instructions accessing the global, in module order
+    SmallVector<GlobalAccess, 4> accesses;
+    // The functions accessing the global, in module order
+    SmallSetVector<const Function *, 4> functions;
+    // The combined kind of all accesses of the global, 0 if it is never accessed directly
+    unsigned kinds = 0;
+};
+
+// The accesses per global variable, in module order
+typedef MapVector<const GlobalVariable *, GlobalAccessEntry> GlobalAccessMap;
+
+/**
+ * Analysis pass which indexes the direct loads and stores of every global variable in the module.
+ *
+ * A function that stores the address of a global to memory may access the global through the stored pointer, so such
+ * a store is recorded as a read and write of the global. Accesses through pointers that are neither based on a global
+ * nor on a local variable cannot be attributed and are only counted per function, so a lookup of a global is complete
+ * only if the functions of interest have no unresolved accesses.
+ */
+struct GlobalAccessIndex : public ModulePass {
+
+    GlobalAccessMap globals;
+    // The number of accesses per function that could not be attributed to a global or local variable
+    DenseMap<const Function *, unsigned> unresolved;
+
+    static char ID;
+
+    GlobalAccessIndex() : ModulePass(ID) {};
+
+    // Pass implementation
+    bool runOnModule(Module &module) override;
+
+    // Printer
+    void print(raw_ostream &os, const Module *) const override;
+
+    // Clean up memory
+    void releaseMemory() override {
+        this->globals.clear();
+        this->unresolved.clear();
+    }
+
+    // Define requirements and behavior
+    void getAnalysisUsage(AnalysisUsage &usage) const override;
+
+    /**
+     * @return The accesses per global variable.
+     */
+    const GlobalAccessMap &getGlobals() const;
+
+    /**
+     * Looks up the accesses of a single global variable.
+     *
+     * @param global The global variable to look up.
+     * @return The accesses of the global, or nullptr if the global is not part of the index.
+     */
+    const GlobalAccessEntry *lookup(const GlobalVariable *global) const;
+
+    /**
+     * @param function The function to look up.
+     * @return The number of accesses of the function that could not be attributed, which may access any global.
+     */
+    unsigned getUnresolved(const Function *function) const;
+
+private:
+
+    /**
+     * Records an access of the global variable underlying the given pointer. Counts the access as unresolved if the
+     * pointer is based on neither a global nor a local variable.
+     *
+     * @param pointer The pointer operand that is accessed.
+     * @param inst The instruction accessing the pointer.
+     * @param kind The kind of access.
+     */
+    void recordAccess(const Value *pointer, const Instruction *inst, GlobalAccessKind kind);
+
+    /**
+     * Records a read and write of the global variable underlying the given value, if any, as the address of the global
+     * escapes into memory.
+     *
+     * @param value The value that is stored.
+     * @param inst The instruction storing the value.
+     */
+    void recordEscape(const Value *value, const Instruction *inst);
+
+    /**
+     * Adds an access to the entry of a global variable.
+     *
+     * @param global The global that is accessed.
+     * @param inst The instruction accessing the global.
+     * @param kind The kind of access.
+     */
+    void addAccess(const GlobalVariable *global, const Instruction *inst, GlobalAccessKind kind);
+
+    /**
+     * String formats the kind of a global access.
+     *
+     * @param kind The kind to format.
+     * @return A short string representation of the kind.
+     */
+    static const char *formatAccessKind(unsigned kind);
+};
+
+#endif //CHECKMERGE_GLOBALACCESSINDEX_H
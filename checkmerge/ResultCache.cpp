@@ -0,0 +1,151 @@
+/**
+ * @file ResultCache.cpp
+ * @author Jan-Jelle Kester
+ *
+ * On-disk cache of analysis results which can be shared between concurrent runs of the analysis.
+ */
+#include "ResultCache.h"
+
+#include <chrono>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/LockFileManager.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+ResultCache::ResultCache(StringRef directory, CachePruningPolicy policy) : directory(directory), policy(policy) {
+    sys::fs::create_directories(directory);
+}
+
+std::string ResultCache::computeKey(const Module &module, StringRef options) {
+    std::string text;
+    raw_string_ostream stream(text);
+    module.print(stream, nullptr);
+    stream.flush();
+
+    MD5 hash;
+    hash.update(options);
+    hash.update(text);
+
+    MD5::MD5Result result;
+    hash.final(result);
+
+    SmallString<32> key;
+    MD5::stringifyResult(result, key);
+    return std::string(key.str());
+}
+
+std::string ResultCache::computeKey(StringRef moduleKey, const Function &function) {
+    MD5 hash;
+    hash.update(moduleKey);
+    hash.update(function.getName());
+
+    MD5::MD5Result result;
+    hash.final(result);
+
+    SmallString<32> key;
+    MD5::stringifyResult(result, key);
+    return std::string(key.str());
+}
+
+std::string ResultCache::getPath(StringRef key) const {
+    // The prefix is required for the entries to be considered when pruning
+    SmallString<128> path(directory);
+    sys::path::append(path, "llvmcache-" + key);
+    return std::string(path.str());
+}
+
+std::string ResultCache::getLockPath(StringRef key) const {
+    // The lock files must not be pruned while they are in use, so they do not share the prefix of the entries
+    SmallString<128> path(directory);
+    sys::path::append(path, "lock-" + key);
+    return std::string(path.str());
+}
+
+bool ResultCache::lookup(StringRef key, std::string &result) const {
+    std::string path = getPath(key);
+
+    ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(path);
+
+    if (!buffer) {
+        return false;
+    }
+
+    result = std::string((*buffer)->getBuffer());
+
+    // Mark the entry as recently used, so it is evicted last
+    int fd;
+    if (!sys::fs::openFileForRead(path, fd)) {
+        sys::fs::setLastModificationAndAccessTime(fd, std::chrono::system_clock::now());
+        sys::Process::SafelyCloseFileDescriptor(fd);
+    }
+
+    return true;
+}
+
+void ResultCache::store(StringRef key, StringRef result) const {
+    // Write to a temporary file first, so other runs never read a partial entry. Temporary files left behind by runs that
+    // were killed share the prefix of the entries, so they are pruned as well.
+    SmallString<128> model(directory);
+    sys::path::append(model, "llvmcache-tmp-%%%%%%%%");
+
+    int fd;
+    SmallString<128> tempPath;
+
+    if (sys::fs::createUniqueFile(model, fd, tempPath)) {
+        return;
+    }
+
+    {
+        raw_fd_ostream stream(fd, true);
+        stream << result;
+    }
+
+    if (sys::fs::rename(tempPath, getPath(key))) {
+        sys::fs::remove(tempPath);
+    }
+}
+
+std::string ResultCache::getOrCompute(StringRef key, function_ref<std::string()> compute, bool &hit) const {
+    std::string result;
+
+    hit = lookup(key, result);
+
+    while (!hit) {
+        LockFileManager lock(getLockPath(key));
+
+        switch (lock) {
+            case LockFileManager::LFS_Error:
+                // The cache cannot be locked, so just compute the result
+                return compute();
+            case LockFileManager::LFS_Owned:
+                // The previous owner may have stored the result since the last lookup
+                if ((hit = lookup(key, result))) {
+                    return result;
+                }
+
+                // This run computes the result and shares it with the others
+                result = compute();
+                store(key, result);
+                return result;
+            case LockFileManager::LFS_Shared:
+                // Another run is computing the result, so wait for it
+                if (lock.waitForUnlock() != LockFileManager::Res_Success) {
+                    return compute();
+                }
+                hit = lookup(key, result);
+                break;
+        }
+    }
+
+    return result;
+}
+
+void ResultCache::prune() const {
+    pruneCache(directory, policy);
+}
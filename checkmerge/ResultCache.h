@@ -0,0 +1,104 @@
+/**
+ * @file ResultCache.h
+ * @author Jan-Jelle Kester
+ *
+ * Definition of an on-disk cache of analysis results which can be shared between concurrent runs of the analysis.
+ */
+#ifndef CHECKMERGE_RESULTCACHE_H
+#define CHECKMERGE_RESULTCACHE_H
+
+#include <string>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/CachePruning.h>
+
+using namespace llvm;
+
+/**
+ * Cache of the formatted analysis results of single functions, stored as files in a directory.
+ *
+ * Entries are keyed by the contents of the module, so runs on identical modules share their results. Runs that need
+ * the same entry at the same time are coalesced: only one of them computes the result while the others wait for it.
+ * The size of the directory is bounded by evicting the least recently used entries.
+ */
+class ResultCache {
+    std::string directory;
+    CachePruningPolicy policy;
+
+public:
+
+    /**
+     * @param directory The directory to store the entries in, which is created if it does not exist.
+     * @param policy The policy used to bound the size of the cache.
+     */
+    ResultCache(StringRef directory, CachePruningPolicy policy);
+
+    /**
+     * Computes the key of a module, which is a hash of the textual representation of the module.
+     *
+     * @param module The module to compute the key of.
+     * @param options A description of the options that influence the results.
+     * @return The key of the module.
+     */
+    static std::string computeKey(const Module &module, StringRef options);
+
+    /**
+     * Computes the key of a function in a module of which the key is known.
+     *
+     * @param moduleKey The key of the module the function is part of.
+     * @param function The function to compute the key of.
+     * @return The key of the function.
+     */
+    static std::string computeKey(StringRef moduleKey, const Function &function);
+
+    /**
+     * Fetches the result with the given key, or computes and stores it if it is not cached. When another run is
+     * computing the same result, waits for that run to finish instead.
+     *
+     * @param key The key of the result.
+     * @param compute The function computing the result if it is not cached.
+     * @param hit Set to whether the result was fetched from the cache.
+     * @return The result.
+     */
+    std::string getOrCompute(StringRef key, function_ref<std::string()> compute, bool &hit) const;
+
+    /**
+     * Evicts the least recently used entries if the cache exceeds the size limits of the policy.
+     */
+    void prune() const;
+
+private:
+
+    /**
+     * @param key The key of an entry.
+     * @return The path of the file of the entry.
+     */
+    std::string getPath(StringRef key) const;
+
+    /**
+     * @param key The key of an entry.
+     * @return The path used to lock the entry while it is computed.
+     */
+    std::string getLockPath(StringRef key) const;
+
+    /**
+     * Reads the entry with the given key and marks it as used.
+     *
+     * @param key The key of the entry.
+     * @param result Set to the contents of the entry if it exists.
+     * @return Whether the entry exists.
+     */
+    bool lookup(StringRef key, std::string &result) const;
+
+    /**
+     * Atomically writes the entry with the given key.
+     *
+     * @param key The key of the entry.
+     * @param result The contents of the entry.
+     */
+    void store(StringRef key, StringRef result) const;
+};
+
+#endif //CHECKMERGE_RESULTCACHE_H
@@ -7,31 +7,18 @@
  */
 #include "SourceVariableMapper.h"
 
-#include <llvm/IR/InstIterator.h>
-#include <llvm/IR/IntrinsicInst.h>
 #include <llvm/Support/FormatVariadic.h>
 
 using namespace llvm;
 
 bool SourceVariableMapper::runOnFunction(Function &function) {
-    // Iterate over the instructions in a function
-    for (Instruction &inst : instructions(function)) {
-        // Check if the instruction is a debug instruction
-        if (auto *dbgInst = dyn_cast<DbgInfoIntrinsic>(&inst)) {
-            // Get variable information
-            const DILocalVariable *sourceVar = dbgInst->getVariable();
-            const Value *localVar = dbgInst->getVariableLocation();
-
-            // Use instruction debug location since this is more accurate
-            const DebugLoc &instDebugLoc = inst.getDebugLoc();
-
-            // Save mapping if relevant
-            if (dbgInst->isAddressOfVariable()) {
-                mapping[localVar].first = sourceVar;
-                mapping[localVar].second = &instDebugLoc;
-            }
-        }
+    // The variables are resolved once per module by the debug information index
+    if (const FunctionDebugInfo *info = getAnalysis<DebugInfoIndex>().lookup(&function)) {
+        mapping = info->variables;
     }
+
+    // We do not modify anything, so return false
+    return false;
 }
 
 void SourceVariableMapper::print(raw_ostream &os, const Module *) const {
@@ -53,6 +40,7 @@ SourceVariableMap SourceVariableMapper::getMapping() const {
 // Dependencies and behavior of this analysis
 void SourceVariableMapper::getAnalysisUsage(AnalysisUsage &usage) const {
     usage.setPreservesAll();
+    usage.addRequired<DebugInfoIndex>();
 }
 
 char SourceVariableMapper::ID = 0;
@@ -12,14 +12,10 @@
 #include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/DebugLoc.h>
 #include <llvm/IR/Value.h>
+#include "DebugInfoIndex.h"
 
 using namespace llvm;
 
-// A source variable with the debug location of the instruction
-typedef std::pair<const DILocalVariable *, const DebugLoc *> SourceVariable;
-// A map between arbitrary values and a source variable
-typedef DenseMap<const Value *, SourceVariable> SourceVariableMap;
-
 struct SourceVariableMapper : public FunctionPass {
 
     static char ID;
@@ -0,0 +1,23 @@
+int counter = 0;
+int limit = 10;
+
+void increment() {
+    counter = counter + 1;
+}
+
+int reached() {
+    return counter >= limit;
+}
+
+void reset() {
+    int *pointer = &counter;
+    *pointer = 0;
+}
+
+int main() {
+    reset();
+    while (!reached()) {
+        increment();
+    }
+    return counter;
+}